@@ -0,0 +1,262 @@
+/****************************************************************************
+ * @file bench.c
+ * @brief Ringbuffer benchmark harness (make bench)
+ *
+ * Usage: ./bench [esize] [burst] [ring_bytes]
+ *
+ * Pinned producer/consumer threads, warmup phase, clock_gettime(MONOTONIC)
+ * timing, ops/sec plus p50/p99/p999 per-op latency for rb_in/rb_out,
+ * rb_peek, the element variants and the zero-copy reserve/peek_ptr paths.
+ * Built with __DYNAMIC_MALLOC__ + __RB_NO_TEST__, the ring lives in a
+ * malloc'd region via rb_init_shm() so the opaque struct needs no layout.
+ ****************************************************************************/
+
+#define _GNU_SOURCE
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include "rb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+#define BENCH_OPS           (1u << 22)  /* timed operations per test */
+#define BENCH_WARMUP_OPS    (1u << 18)
+#define BENCH_SAMPLE_SHIFT  4           /* sample latency every 16th op */
+#define BENCH_MAX_SAMPLES   (BENCH_OPS >> BENCH_SAMPLE_SHIFT)
+
+/****************************************************************************
+ * Private Data Declarations
+ ****************************************************************************/
+static uint32_t g_esize = 64;
+static uint32_t g_burst = 1;
+static uint32_t g_ring_bytes = 1u << 20;
+
+static struct ringbuffer *g_rb;
+static uint64_t g_lat_in[BENCH_MAX_SAMPLES];
+static uint64_t g_lat_out[BENCH_MAX_SAMPLES];
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+
+static void pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        fprintf(stderr, "warn: cannot pin to cpu %d\n", cpu);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x < y) ? -1 : (x > y);
+}
+
+static void report(const char *name, uint64_t *lat, uint32_t nlat,
+                   uint64_t ops, uint64_t total_ns)
+{
+    qsort(lat, nlat, sizeof(uint64_t), cmp_u64);
+    printf("%-16s %10.2f Mops/s  p50 %5lu ns  p99 %5lu ns  p999 %5lu ns\n",
+           name,
+           (double)ops * 1000.0 / (double)total_ns,
+           (unsigned long)lat[nlat / 2],
+           (unsigned long)lat[(uint32_t)(nlat * 0.99)],
+           (unsigned long)lat[(uint32_t)(nlat * 0.999)]);
+}
+
+/* producer side of the threaded SPSC test */
+static void *bench_producer(void *arg)
+{
+    uint32_t i, done, len = g_esize * g_burst;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    uint64_t t0, t1, start;
+
+    (void)arg;
+    pin_to_cpu(0);
+    memset(buf, 0x5a, len);
+
+    for (i = 0; i < BENCH_WARMUP_OPS; i++)
+        rb_in(g_rb, buf, len);
+
+    start = now_ns();
+    for (i = 0; i < BENCH_OPS; i++) {
+        t0 = now_ns();
+        done = 0;
+        do {
+            done += rb_in(g_rb, buf + done, len - done);
+        } while (done < len);
+        t1 = now_ns();
+        if ((i & ((1u << BENCH_SAMPLE_SHIFT) - 1)) == 0)
+            g_lat_in[i >> BENCH_SAMPLE_SHIFT] = t1 - t0;
+    }
+
+    free(buf);
+    return ((void *)(uintptr_t)(now_ns() - start));
+}
+
+/* consumer side of the threaded SPSC test */
+static void *bench_consumer(void *arg)
+{
+    uint32_t i, done, len = g_esize * g_burst;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    uint64_t t0, t1, start;
+
+    (void)arg;
+    pin_to_cpu(1);
+
+    for (i = 0; i < BENCH_WARMUP_OPS; i++)
+        rb_out(g_rb, buf, len);
+
+    start = now_ns();
+    for (i = 0; i < BENCH_OPS; i++) {
+        t0 = now_ns();
+        done = 0;
+        do {
+            done += rb_out(g_rb, buf + done, len - done);
+        } while (done < len);
+        t1 = now_ns();
+        if ((i & ((1u << BENCH_SAMPLE_SHIFT) - 1)) == 0)
+            g_lat_out[i >> BENCH_SAMPLE_SHIFT] = t1 - t0;
+    }
+
+    free(buf);
+    return ((void *)(uintptr_t)(now_ns() - start));
+}
+
+static void bench_spsc_threads(void)
+{
+    pthread_t pid_in, pid_out;
+    void *ns_in, *ns_out;
+
+    pthread_create(&pid_in, NULL, bench_producer, NULL);
+    pthread_create(&pid_out, NULL, bench_consumer, NULL);
+    pthread_join(pid_in, &ns_in);
+    pthread_join(pid_out, &ns_out);
+
+    report("rb_in", g_lat_in, BENCH_MAX_SAMPLES, BENCH_OPS,
+           (uint64_t)(uintptr_t)ns_in);
+    report("rb_out", g_lat_out, BENCH_MAX_SAMPLES, BENCH_OPS,
+           (uint64_t)(uintptr_t)ns_out);
+}
+
+/* single-threaded fill+drain loops for the remaining entry points */
+static void bench_single(const char *name, int which)
+{
+    uint32_t i, len = g_esize * g_burst;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    uint8_t *p1, *p2;
+    const uint8_t *c1, *c2;
+    uint32_t l1, l2;
+    uint64_t t0, t1, start;
+
+    memset(buf, 0x5a, len);
+
+    for (i = 0; i < BENCH_WARMUP_OPS; i++) {
+        rb_in(g_rb, buf, len);
+        rb_out(g_rb, buf, len);
+    }
+
+    start = now_ns();
+    for (i = 0; i < BENCH_OPS; i++) {
+        t0 = now_ns();
+        switch (which) {
+        case 0: /* rb_peek */
+            rb_in(g_rb, buf, len);
+            rb_peek(g_rb, buf, len);
+            rb_skip(g_rb, len);
+            break;
+        case 1: /* element granular */
+            rb_in_elem(g_rb, buf, g_burst);
+            rb_out_elem(g_rb, buf, g_burst);
+            break;
+        case 2: /* zero-copy reserve/commit + peek_ptr/skip */
+            rb_in_reserve(g_rb, len, &p1, &l1, &p2, &l2);
+            memset(p1, 0x5a, l1);
+            memset(p2, 0x5a, l2);
+            rb_in_commit(g_rb, l1 + l2);
+            rb_out_peek_ptr(g_rb, &c1, &l1, &c2, &l2);
+            rb_skip(g_rb, l1 + l2);
+            break;
+        }
+        t1 = now_ns();
+        if ((i & ((1u << BENCH_SAMPLE_SHIFT) - 1)) == 0)
+            g_lat_in[i >> BENCH_SAMPLE_SHIFT] = t1 - t0;
+    }
+
+    report(name, g_lat_in, BENCH_MAX_SAMPLES, BENCH_OPS, now_ns() - start);
+    free(buf);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    void *mem;
+
+    if (argc > 1)
+        g_esize = (uint32_t)atoi(argv[1]);
+    if (argc > 2)
+        g_burst = (uint32_t)atoi(argv[2]);
+    if (argc > 3)
+        g_ring_bytes = (uint32_t)atoi(argv[3]);
+
+    /* header carries _Alignas(64) members, plain malloc is not enough;
+     * round the size up, C11 aligned_alloc wants a multiple of 64 */
+    mem = aligned_alloc(64, (g_ring_bytes + 63u) & ~63u);
+    if (mem == NULL)
+        return -1;
+
+    g_rb = rb_init_shm(mem, g_ring_bytes, g_esize);
+    if (g_rb == NULL) {
+        fprintf(stderr, "rb_init_shm failed\n");
+        return -1;
+    }
+
+    printf("ring %u bytes, esize %u, burst %u, %u ops/test\n",
+           rb_size(g_rb), g_esize, g_burst, BENCH_OPS);
+
+    bench_spsc_threads();
+    bench_single("rb_peek", 0);
+    bench_single("rb_in/out_elem", 1);
+    bench_single("zero-copy", 2);
+
+    rb_deinit(g_rb);
+    free(mem);
+
+#ifdef __linux__
+    /* mirror backend: zero-copy regions are always contiguous (len2 == 0),
+     * the wrap split and second memcpy disappear */
+    g_rb = rb_init_mirror(g_ring_bytes / g_esize, g_esize);
+    if (g_rb == NULL) {
+        fprintf(stderr, "rb_init_mirror failed\n");
+        return -1;
+    }
+    bench_single("zero-copy mirror", 2);
+    rb_deinit(g_rb);
+#endif
+    return 0;
+}
@@ -18,7 +18,9 @@
 
  1、环形队列中存储元素需为同一类型
 
- 2、如果为单一生产者与单一消费者模型，循环队列不需使用锁、信号量等保护数据区
+ 2、如果为单一生产者与单一消费者模型，循环队列不需使用锁、信号量等保护数据区，
+    内部in/out索引为C11原子变量，以acquire/release语义访问，弱内存序CPU
+    (如aarch64)上同样保证数据先于索引对对端可见
     如果非单一生产者+单一消费者模型，需使用锁、临界区、信号量等措施保护数据
 
  3、环形队列长度必须是2的N次幂，如128， 256， 512等，队列长度在初始化接口中计算,
@@ -38,7 +40,10 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* bench等自带main()的target编译时定义__RB_NO_TEST__排除内置测试 */
+#ifndef __RB_NO_TEST__
 #define __TEST_ON_LINUX__   1
+#endif // !__RB_NO_TEST__
 
 //#define __DYNAMIC_MALLOC__
 
@@ -47,11 +52,29 @@
 #define RB_BUF_LEN 256
 #endif // !__DYNAMIC_MALLOC__
 
+/* cache line长度，用于将生产者索引in、消费者索引out以及只读字段
+   (mask/size/esize/data)分别对齐到独立cache line，避免双核收发时
+   false sharing。嵌入式静态编译如不在乎padding开销，可定义为0关闭 */
+#ifndef RB_CACHELINE
+#define RB_CACHELINE 64
+#endif // !RB_CACHELINE
+
 
 /****************************************************************************
  * Public Type Declarations
  ****************************************************************************/
 
+/* in/out索引类型。默认32位：索引free-running, 2^32字节后回绕,
+   容量判断依赖无符号回绕语义, 功能不受影响。定义__RB_IDX64__可
+   切换为64位：索引即自队列创建以来的累计字节偏移, 实际使用中不再
+   回绕, rb_tell_in/rb_tell_out的返回值可直接用作持久化流位置
+   (与rb_init_file配合跨重启继续), futex等待在索引低32位字上进行 */
+#ifdef __RB_IDX64__
+typedef uint64_t rb_idx_t;
+#else // !__RB_IDX64__
+typedef uint32_t rb_idx_t;
+#endif // !__RB_IDX64__
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -84,6 +107,234 @@ extern "C" {
  ****************************************************************************/
 int rb_init(struct ringbuffer *r, uint32_t len, uint32_t esize);
 
+#ifdef __DYNAMIC_MALLOC__
+/****************************************************************************
+ * rb_init_shm()    在调用方提供的(共享)内存上初始化ring buffer
+ * @mem:            内存基地址，如mmap得到的共享内存映射
+ * @memlen:         该段内存的总长度
+ * @esize:          需存储的单个元素的长度
+ *
+ * header与数据区连续存放在mem中，数据区紧随header并以相对偏移寻址，
+ * 因此同一段共享内存在两个进程中映射到不同基地址时均可直接使用，
+ * 结合SPSC原子索引可实现零系统调用的跨进程传输
+ *
+ * mem必须按64字节(cache line)对齐：header内的字段带_Alignas(64)，
+ * mmap返回页对齐天然满足；堆上分配请用aligned_alloc(64, memlen)，
+ * malloc仅保证16字节对齐，不满足要求
+ *
+ * 队列长度 = (memlen - header长度) 向下取2的N次幂
+ *
+ * 返回值：         队列句柄(即mem)，失败返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_init_shm(void *mem, uint32_t memlen, uint32_t esize);
+
+/****************************************************************************
+ * rb_open_shm()    从已由对端进程初始化的共享内存上获取队列句柄
+ * @mem:            共享内存基地址
+ *
+ * 返回值：         队列句柄，该内存未经rb_init_shm()初始化时返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_open_shm(void *mem);
+
+#ifdef __linux__
+/****************************************************************************
+ * rb_init_mirror() 初始化"magic ring"：同一段物理页在虚拟地址上
+ *                  背靠背映射两次(memfd + 两次mmap)
+ * @len:            元素个数
+ * @esize:          需存储的单个元素的长度
+ *
+ * 任意索引起连续size字节均可直接访问，回绕拆分与第二次memcpy
+ * 彻底消失，每次存取/peek为单次memcpy；rb_in_reserve()/
+ * rb_out_peek_ptr()返回的区域永远连续(len2恒为0)
+ *
+ * 队列长度 = esize * len 向上取2的N次幂，且至少为一个页面；
+ * header由本接口分配(struct ringbuffer对外不透明), rb_deinit()
+ * 释放映射与header
+ *
+ * 返回值：         队列句柄, 失败返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_init_mirror(uint32_t len, uint32_t esize);
+
+/****************************************************************************
+ * rb_init_file()   初始化文件映射的持久化队列：header与数据区整体
+ *                  mmap到指定文件上, in/out索引随header一起落盘
+ * @path:           后备文件路径, 已存在时会被截断重建
+ * @len:            元素个数
+ * @esize:          需存储的单个元素的长度
+ *
+ * 布局与rb_init_shm()相同(偏移寻址), 队列长度 = esize * len
+ * 向上取2的N次幂; 调用rb_sync()可将当前内容与索引刷回文件,
+ * rb_deinit()自动落盘并解除映射(索引不清零, 供下次rb_open_file)
+ *
+ * 返回值：         队列句柄, 失败返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_init_file(const char *path, uint32_t len,
+                                uint32_t esize);
+
+/****************************************************************************
+ * rb_open_file()   重新打开已由rb_init_file()创建的持久化队列,
+ *                  进程重启后从文件中保存的in/out索引处继续收发
+ * @path:           后备文件路径
+ *
+ * 返回值：         队列句柄, 文件不存在或布局非法时返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_open_file(const char *path);
+
+/****************************************************************************
+ * rb_sync()    将持久化队列的脏数据区间与header刷回后备文件
+ * @r:          ring buffer 数据结构(须由rb_init_file/rb_open_file创建)
+ *
+ * 仅msync out到in之间的回绕区间(按页对齐, 最多两段)与header首页,
+ * 而非整个数据区; 数据段先于header落盘, 保证文件中索引指向的
+ * 数据总是完整的
+ *
+ * 返回值：     0 成功
+ *              -1 失败或非文件映射队列
+ ****************************************************************************/
+int rb_sync(struct ringbuffer *r);
+#endif /* __linux__ */
+
+struct rb_pool;
+
+typedef void (*rb_pool_iter_fn)(struct ringbuffer *r, void *arg);
+
+/****************************************************************************
+ * rb_pool_create()     创建ring池：一次分配N个ring的header与数据区
+ * @nrings:             池中ring个数
+ * @len:                单个ring的元素个数
+ * @esize:              单个元素的长度
+ *
+ * header紧凑排布、数据区按队列长度对齐连续排布在同一arena中，
+ * 取代每连接一次malloc带来的堆碎片与启动开销
+ *
+ * 返回值：             池句柄，失败返回NULL
+ *
+ * Note：               acquire/release/遍历等池管理操作需调用方串行化，
+ *                      各ring内部收发仍为SPSC无锁
+ ****************************************************************************/
+struct rb_pool *rb_pool_create(uint32_t nrings, uint32_t len,
+                               uint32_t esize);
+
+/****************************************************************************
+ * rb_pool_destroy()    销毁ring池并释放arena
+ ****************************************************************************/
+void rb_pool_destroy(struct rb_pool *p);
+
+/****************************************************************************
+ * rb_pool_acquire()    O(1)取出一个空闲ring，索引已复位
+ *
+ * 返回值：             ring句柄，池耗尽返回NULL
+ ****************************************************************************/
+struct ringbuffer *rb_pool_acquire(struct rb_pool *p);
+
+/****************************************************************************
+ * rb_pool_release()    O(1)归还ring，r必须来自同一个池
+ ****************************************************************************/
+void rb_pool_release(struct rb_pool *p, struct ringbuffer *r);
+
+/****************************************************************************
+ * rb_pool_for_each_ready()     只遍历已取出且非空的ring
+ * @p:                          池句柄
+ * @fn:                         对每个命中的ring调用的回调，可为NULL
+ * @arg:                        透传给回调的参数
+ *
+ * 返回值：                     命中(非空)的ring个数
+ ****************************************************************************/
+uint32_t rb_pool_for_each_ready(struct rb_pool *p, rb_pool_iter_fn fn,
+                                void *arg);
+
+/****************************************************************************
+ * rb_grow()    将队列扩容到至少能容纳len个元素(向上取2的N次幂)
+ * @r:          ring buffer 数据结构(须为rb_init初始化的动态队列)
+ * @len:        扩容后的元素个数, 不大于当前容量时直接返回成功
+ *
+ * 重新分配数据区并把[out, in)间的至多两段回绕区间按新掩码重新
+ * 线性化, in/out索引保持不变. 扩容期间无法与收发并发：调用方须
+ * 保证生产者与消费者均已静默(外部同步), 仅扩容这一罕见路径需要,
+ * 正常收发仍是无锁的
+ *
+ * 返回值：     0 成功
+ *              -1 失败(分配失败或共享内存/双重映射队列)
+ ****************************************************************************/
+int rb_grow(struct ringbuffer *r, uint32_t len);
+
+/****************************************************************************
+ * rb_in_grow()     与rb_in相同, 但空间不足即将截断时先尝试扩容
+ * @r:              ring buffer 数据结构
+ * @buf:            待存储数据
+ * @len:            待存储数据长度
+ *
+ * 扩容失败时退化为普通rb_in(可能截断); 同rb_grow, 调用期间
+ * 消费者须静默, 适合启动小内存、按需增长的单线程装配阶段
+ *
+ * 返回值：         实际存储数据长度
+ ****************************************************************************/
+uint32_t rb_in_grow(struct ringbuffer *r, const uint8_t *buf, uint32_t len);
+
+#ifdef __RB_SET__
+/* 编译期使能(-D__RB_SET__)的多ring就绪集合, 单个消费者线程用一个
+ * 64位位图聚合监听至多RB_SET_MAX个ring, 未使能时热路径零开销 */
+#define RB_SET_MAX  64
+
+struct rb_set;
+
+/****************************************************************************
+ * rb_set_create()  创建就绪集合
+ *
+ * 返回值：         集合句柄, 失败返回NULL
+ ****************************************************************************/
+struct rb_set *rb_set_create(void);
+
+/****************************************************************************
+ * rb_set_destroy() 销毁就绪集合, 自动解除所有成员ring的关联
+ ****************************************************************************/
+void rb_set_destroy(struct rb_set *s);
+
+/****************************************************************************
+ * rb_set_add()     将ring加入集合
+ * @s:              集合句柄
+ * @r:              ring buffer 数据结构
+ *
+ * 加入后该ring的生产者在发布数据时把对应位OR进summary字
+ * (边沿触发, 位已置位时仅一次本地读); 一个ring只能属于一个集合
+ *
+ * 返回值：         该ring在位图中的位号(0..RB_SET_MAX-1)
+ *                  -1 失败, 集合已满或ring已在其他集合中
+ ****************************************************************************/
+int rb_set_add(struct rb_set *s, struct ringbuffer *r);
+
+/****************************************************************************
+ * rb_set_del()     将ring移出集合
+ *
+ * 返回值：         0 成功, -1 该ring不在此集合中
+ ****************************************************************************/
+int rb_set_del(struct rb_set *s, struct ringbuffer *r);
+
+/****************************************************************************
+ * rb_set_poll()    非阻塞取走就绪位图
+ * @s:              集合句柄
+ *
+ * 位图被整字取走并清零; 为防"位已清除但数据未排空"漏报,
+ * 返回前会按rb_avail兜底重扫成员ring
+ *
+ * 返回值：         就绪位图, bit i对应rb_set_add返回位号为i的ring
+ ****************************************************************************/
+uint64_t rb_set_poll(struct rb_set *s);
+
+#ifdef __linux__
+/****************************************************************************
+ * rb_set_wait()    等待集合中任一ring就绪, 与rb_set_poll相同但
+ *                  位图为空时在futex上休眠, 由生产者发布新位时唤醒
+ * @s:              集合句柄
+ * @timeout_ms:     0 不等待, <0 无限等待, >0 超时毫秒数
+ *
+ * 返回值：         就绪位图, 超时返回0
+ ****************************************************************************/
+uint64_t rb_set_wait(struct rb_set *s, int timeout_ms);
+#endif /* __linux__ */
+#endif /* __RB_SET__ */
+#endif /* __DYNAMIC_MALLOC__ */
+
 /****************************************************************************
  * rb_deinit()  初始化ring buffer
  * @r:          ring buffer 数据结构，为静态变量地址或堆指针
@@ -94,6 +345,14 @@ int rb_init(struct ringbuffer *r, uint32_t len, uint32_t esize);
  ****************************************************************************/
 void rb_deinit(struct ringbuffer *r);
 
+/****************************************************************************
+ * rb_size()    获取队列长度
+ * @r:          ring buffer 数据结构
+ *
+ * 返回值：     初始化时计算得到的队列长度(2的N次幂)
+ ****************************************************************************/
+uint32_t rb_size(struct ringbuffer *r);
+
 /****************************************************************************
  * rb_in()      将数据存入循环队列
  * @r:          ring buffer 数据结构
@@ -107,6 +366,58 @@ void rb_deinit(struct ringbuffer *r);
  ****************************************************************************/
 uint32_t rb_in(struct ringbuffer *r, const uint8_t *buf, uint32_t len);
 
+/****************************************************************************
+ * rb_in_elem()     以元素为单位将数据存入循环队列
+ * @r:              ring buffer 数据结构
+ * @buf:            待存储数据，长度至少为 n_elems * esize
+ * @n_elems:        待存储的元素个数
+ *
+ * 只传输整数个esize大小的元素，不会出现半个元素入队的情况，
+ * 定长记录队列无需再做短写重试循环
+ *
+ * 返回值：         实际存入的元素个数，空间不足时 < n_elems
+ ****************************************************************************/
+uint32_t rb_in_elem(struct ringbuffer *r, const void *buf, uint32_t n_elems);
+
+/****************************************************************************
+ * rb_out_elem()    以元素为单位从循环队列中读取数据
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer，长度至少为 n_elems * esize
+ * @n_elems:        需读取的元素个数
+ *
+ * 只传输整数个esize大小的元素，不会读出半个元素
+ *
+ * 返回值：         实际读取的元素个数，数据不足时 < n_elems
+ ****************************************************************************/
+uint32_t rb_out_elem(struct ringbuffer *r, void *buf, uint32_t n_elems);
+
+/****************************************************************************
+ * rb_in_reserve()  预约写入空间，返回指向队列内部buffer的直接指针
+ * @r:              ring buffer 数据结构
+ * @len:            期望预约的空间长度
+ * @ptr1/@len1:     第一段连续区域的指针与长度
+ * @ptr2/@len2:     回绕后第二段连续区域的指针与长度，无回绕时len2为0
+ *
+ * 调用方直接向ptr1/ptr2序列化数据(共计不超过返回值字节)，
+ * 再调用rb_in_commit()发布，省去rb_in()的一次staging memcpy
+ *
+ * 返回值：         实际预约到的空间长度，空间不足时 < len
+ *
+ * Note：           预约到发布期间in索引不变，生产者单线程使用
+ ****************************************************************************/
+uint32_t rb_in_reserve(struct ringbuffer *r, uint32_t len,
+                       uint8_t **ptr1, uint32_t *len1,
+                       uint8_t **ptr2, uint32_t *len2);
+
+/****************************************************************************
+ * rb_in_commit()   发布之前通过rb_in_reserve()预约并填充的数据
+ * @r:              ring buffer 数据结构
+ * @len:            实际填充的数据长度，不得超过rb_in_reserve()的返回值
+ *
+ * 返回值：         无
+ ****************************************************************************/
+void rb_in_commit(struct ringbuffer *r, uint32_t len);
+
 /****************************************************************************
  * rb_out()     从环形队列中读取数据
  * @r:          ring buffer 数据结构
@@ -119,6 +430,225 @@ uint32_t rb_in(struct ringbuffer *r, const uint8_t *buf, uint32_t len);
  ****************************************************************************/
 uint32_t rb_out(struct ringbuffer *r, void *buf, uint32_t len);
 
+/****************************************************************************
+ * rb_out_drain()   与rb_out相同, 但按chunk软件流水排空：拷贝当前
+ *                  chunk的同时预取下一chunk
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @len:            需要读取的数据长度 or buffer 的长度
+ *
+ * 适合一次排空远大于cache的积压数据(捕获ring落盘等), 访存延迟被
+ * 拷贝掩盖; chunk大小与预取驻留层级(L2或NTA)由编译期参数
+ * RB_PF_CHUNK/RB_PF_LOCALITY调整, 小块读取直接用rb_out即可
+ *
+ * 返回值：         实际读取的数据长度
+ ****************************************************************************/
+uint32_t rb_out_drain(struct ringbuffer *r, uint8_t *buf, uint32_t len);
+
+/****************************************************************************
+ * rb_in_rec()      以记录为单位写入：内部长度头 + 变长payload，
+ *                  整条原子写入(all-or-nothing)，绝不出现半条记录
+ * @r:              ring buffer 数据结构
+ * @buf:            记录payload
+ * @len:            payload长度
+ *
+ * 消费侧无需同步字扫描与分段读取循环，与rb_out_rec()配对使用，
+ * 不可与字节流接口在同一队列上混用
+ *
+ * 返回值：         len 写入成功
+ *                  0 空间不足或记录本身超过队列长度，未写入任何数据
+ ****************************************************************************/
+uint32_t rb_in_rec(struct ringbuffer *r, const uint8_t *buf, uint32_t len);
+
+/****************************************************************************
+ * rb_in_overwrite()    覆盖式写入：空间不足时在同一次调用内推进out
+ *                      丢弃最旧数据，写入永不截断、永不阻塞
+ * @r:                  ring buffer 数据结构
+ * @buf:                待存储数据
+ * @len:                待存储数据长度，超过队列长度时只保留最新部分
+ *
+ * 适用于调试trace、metrics等允许丢旧数据的场景。
+ *
+ * 返回值：             实际写入长度(即len，超长时为队列长度)
+ *
+ * Note：               覆盖发生时生产者会写out索引，与并发消费者存在
+ *                      竞争，仅限消费者暂停或同线程读取的trace用法
+ ****************************************************************************/
+uint32_t rb_in_overwrite(struct ringbuffer *r, const uint8_t *buf,
+                         uint32_t len);
+
+/****************************************************************************
+ * rb_in_rec_overwrite()    记录模式的覆盖式写入：空间不足时整条丢弃
+ *                          最旧记录，与rb_out_rec()配对使用
+ * @r:                      ring buffer 数据结构
+ * @buf:                    记录payload
+ * @len:                    payload长度
+ *
+ * 返回值：                 len 写入成功
+ *                          0 记录本身超过队列长度
+ *
+ * Note：                   并发限制同rb_in_overwrite()
+ ****************************************************************************/
+uint32_t rb_in_rec_overwrite(struct ringbuffer *r, const uint8_t *buf,
+                             uint32_t len);
+
+/****************************************************************************
+ * rb_out_rec()     读出恰好一条完整记录
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @cap:            buffer容量
+ *
+ * 返回值：         记录的payload长度，队列空时返回0；
+ *                  cap不足时仅拷贝cap字节，剩余部分被丢弃，
+ *                  返回值仍为完整记录长度
+ ****************************************************************************/
+uint32_t rb_out_rec(struct ringbuffer *r, void *buf, uint32_t cap);
+
+/****************************************************************************
+ * rb_in_rec_crc()  与rb_in_rec相同, 但记录头中额外携带payload校验和
+ * @r:              ring buffer 数据结构
+ * @buf:            待存储数据
+ * @len:            待存储数据长度
+ *
+ * 校验和在写入payload的同一遍源数据扫描中算出(支持SSE4.2/ARMv8
+ * 时为硬件CRC32C, 否则为简单加和), 不引入第二次内存扫描; 仅与
+ * rb_out_rec_crc()配对使用, 帧格式与rb_in_rec不兼容
+ *
+ * 返回值：         实际存储的payload长度，空间不足或记录本身
+ *                  超过队列长度时返回0
+ ****************************************************************************/
+uint32_t rb_in_rec_crc(struct ringbuffer *r, const uint8_t *buf,
+                       uint32_t len);
+
+/****************************************************************************
+ * rb_out_rec_crc() 读出并验证恰好一条带校验和的记录
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @cap:            buffer容量
+ *
+ * 在数据区上就地验证payload校验和(cap截断时依然校验完整记录),
+ * 校验失败的记录整条丢弃; 长度头先于payload校验, 长度超过容量
+ * 即视为损坏, 此时帧同步已不可恢复, 丢弃全部缓存数据重新同步
+ *
+ * 返回值：         >0 记录的payload长度
+ *                  0 队列空
+ *                  -1 校验失败(记录已丢弃)
+ ****************************************************************************/
+int rb_out_rec_crc(struct ringbuffer *r, void *buf, uint32_t cap);
+
+#ifdef __linux__
+
+struct iovec;
+
+/****************************************************************************
+ * rb_in_v()        向量化批量写入，一次调用提交多个数据分片
+ * @r:              ring buffer 数据结构
+ * @iov:            数据分片数组(如recvmmsg()收到的一批报文)
+ * @cnt:            分片个数
+ *
+ * 回绕拆分只计算一次，所有分片依次流入数据区，in索引仅在
+ * 末尾发布一次，摊薄每报文一次rb_in()调用的固定开销
+ *
+ * 返回值：         实际存入的数据总长度，空间不足时尾部分片被截断
+ ****************************************************************************/
+uint32_t rb_in_v(struct ringbuffer *r, const struct iovec *iov, int cnt);
+
+/****************************************************************************
+ * rb_out_v()       向量化批量读取，一次调用填充多个分片buffer
+ * @r:              ring buffer 数据结构
+ * @iov:            读取目标分片数组
+ * @cnt:            分片个数
+ *
+ * 返回值：         实际读取的数据总长度，out索引仅在末尾发布一次
+ ****************************************************************************/
+uint32_t rb_out_v(struct ringbuffer *r, const struct iovec *iov, int cnt);
+
+/****************************************************************************
+ * rb_in_wait()     阻塞式写入，队列满时在futex上休眠而非轮询
+ * @r:              ring buffer 数据结构
+ * @buf:            待存储数据
+ * @len:            待存储数据长度
+ * @timeout_ms:     单次等待的超时时间(毫秒)，< 0 表示无限等待
+ *
+ * 队列有空间时与rb_in()完全相同(无锁快速路径)，满时在out索引上
+ * futex休眠，由对端在满->不满转换时唤醒，不再需要usleep轮询。
+ * 阻塞用法需生产者/消费者两侧配对使用_wait接口(唤醒由对端发出)
+ *
+ * 返回值：         实际存入的数据长度，超时时 < len
+ ****************************************************************************/
+uint32_t rb_in_wait(struct ringbuffer *r, const uint8_t *buf, uint32_t len,
+                    int timeout_ms);
+
+/****************************************************************************
+ * rb_out_wait()    阻塞式读取，队列空时在futex上休眠而非轮询
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @len:            需要读取的数据长度
+ * @timeout_ms:     单次等待的超时时间(毫秒)，< 0 表示无限等待
+ *
+ * 返回值：         实际读取的数据长度，超时时 < len
+ ****************************************************************************/
+uint32_t rb_out_wait(struct ringbuffer *r, void *buf, uint32_t len,
+                     int timeout_ms);
+#endif /* __linux__ */
+
+/****************************************************************************
+ * rb_out_peek_ptr()    获取指向队列内可读数据的直接指针，不拷贝不消费
+ * @r:                  ring buffer 数据结构
+ * @ptr1/@len1:         第一段连续可读区域的指针与长度
+ * @ptr2/@len2:         回绕后第二段连续可读区域的指针与长度，
+ *                      无回绕时len2为0
+ *
+ * 与rb_in_reserve()对称：解析方直接在队列内部buffer上扫描/消费
+ * (如查找同步字后交给writev())，省去rb_peek()的staging拷贝，
+ * 确认消费后调用rb_skip()推进out索引
+ *
+ * 返回值：             当前可读数据总长度(len1 + len2)
+ *
+ * Note：               指针在下一次rb_skip()/rb_out()前有效，
+ *                      消费者单线程使用
+ ****************************************************************************/
+uint32_t rb_out_peek_ptr(struct ringbuffer *r,
+                         const uint8_t **ptr1, uint32_t *len1,
+                         const uint8_t **ptr2, uint32_t *len2);
+
+/****************************************************************************
+ * rb_find()    在队列内原地查找指定字节，无staging拷贝
+ * @r:          ring buffer 数据结构
+ * @byte:       查找的目标字节(如同步字的首字节、行分隔符)
+ * @offset:     从当前可读数据的该偏移处开始查找
+ *
+ * 以memchr扫描两段连续区域，resync路径无需再整buffer peek拷贝
+ *
+ * 返回值：     目标字节相对可读数据起点的偏移，未找到返回-1
+ ****************************************************************************/
+int rb_find(struct ringbuffer *r, uint8_t byte, uint32_t offset);
+
+/****************************************************************************
+ * rb_out_until()   原地扫描并读出到第一个分隔符为止(含分隔符)
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @cap:            buffer容量
+ * @delim:          分隔符(如'\n')
+ *
+ * 先扫描后拷贝，只拷贝恰好一行，O(1)进度不再做O(n)全量拷贝
+ *
+ * 返回值：         该行长度(含分隔符)，未找到分隔符返回0且不消费；
+ *                  cap不足时仅拷贝cap字节，整行仍被消费，
+ *                  返回值仍为完整行长度
+ ****************************************************************************/
+uint32_t rb_out_until(struct ringbuffer *r, void *buf, uint32_t cap,
+                      uint8_t delim);
+
+/****************************************************************************
+ * rb_skip()    丢弃/确认消费len字节，仅推进out索引，无任何拷贝
+ * @r:          ring buffer 数据结构
+ * @len:        需跳过的数据长度
+ *
+ * 返回值：     实际跳过的数据长度，队列数据不足时 < len
+ ****************************************************************************/
+uint32_t rb_skip(struct ringbuffer *r, uint32_t len);
+
 /****************************************************************************
  * rb_unused()  获取当前队列中剩余空间
  * @r:          ring buffer 数据结构
@@ -127,6 +657,18 @@ uint32_t rb_out(struct ringbuffer *r, void *buf, uint32_t len);
  ****************************************************************************/
 uint32_t rb_unused(struct ringbuffer *r);
 
+/****************************************************************************
+ * rb_tell_in()     返回生产者索引(自队列创建以来的累计写入字节偏移)
+ * rb_tell_out()    返回消费者索引(自队列创建以来的累计读出字节偏移)
+ * @r:              ring buffer 数据结构
+ *
+ * 默认32位索引下偏移每2^32字节回绕一次; 定义__RB_IDX64__后为64位
+ * 单调递增偏移, 可直接用作持久化的流位置(配合rb_init_file跨重启
+ * 续传)或跨模块的序号基准
+ ****************************************************************************/
+rb_idx_t rb_tell_in(struct ringbuffer *r);
+rb_idx_t rb_tell_out(struct ringbuffer *r);
+
 /****************************************************************************
  * rb_avail()   当前队列中可用数据长度
  * @r:          ring buffer 数据结构
@@ -153,6 +695,56 @@ uint32_t rb_is_empty(struct ringbuffer *r);
  ****************************************************************************/
 uint32_t rb_is_full(struct ringbuffer *r);
 
+#ifdef __RB_STATS__
+/* 编译期使能(-D__RB_STATS__)的统计信息，热路径代价为每侧一次普通自增 */
+struct rb_stats {
+    uint64_t bytes_in;      /* 累计写入字节数 */
+    uint64_t bytes_out;     /* 累计读出字节数 */
+    uint64_t short_in;      /* 短写(空间不足被截断/拒绝)次数 */
+    uint64_t empty_out;     /* 空读次数 */
+    uint64_t wraps;         /* 写索引回绕次数 */
+    uint64_t high_water;    /* 队列占用高水位(字节, 近似值) */
+};
+
+/****************************************************************************
+ * rb_stats_read()  读取统计信息快照，供metrics导出线程轮询
+ * @r:              ring buffer 数据结构
+ * @st:             快照输出
+ *
+ * 计数器为各侧普通变量，快照为瞬时近似值，不影响收发热路径
+ ****************************************************************************/
+void rb_stats_read(struct ringbuffer *r, struct rb_stats *st);
+
+/****************************************************************************
+ * rb_stats_reset() 统计信息清零
+ ****************************************************************************/
+void rb_stats_reset(struct ringbuffer *r);
+#endif /* __RB_STATS__ */
+
+#ifdef __RB_WATERMARK__
+/* 编译期使能(-D__RB_WATERMARK__)的水位通知, 未使能时热路径零开销 */
+typedef void (*rb_wm_cb)(struct ringbuffer *r, void *arg);
+
+/****************************************************************************
+ * rb_set_watermarks()  配置高低水位及边沿触发回调
+ * @r:                  ring buffer 数据结构
+ * @low:                低水位(剩余空间字节数), 0 表示不启用
+ * @high:               高水位(数据量字节数), 0 表示不启用
+ * @low_cb:             消费者释放空间上穿low水位时回调(通知生产者)
+ * @high_cb:            生产者写入数据上穿high水位时回调(通知消费者)
+ * @arg:                回调透传参数
+ *
+ * 回调仅在水位被边沿穿越的那一次发布时触发, 水位中间区间不重复通知,
+ * 便于批量唤醒(回调内可rb_futex_wake或写eventfd); 回调在收发调用者
+ * 上下文执行, 不得阻塞. 水位判断基于本侧缓存的对端索引, 为近似值
+ *
+ * 返回值：             0 成功
+ *                      -1 失败, 水位超过队列容量
+ ****************************************************************************/
+int rb_set_watermarks(struct ringbuffer *r, uint32_t low, uint32_t high,
+                      rb_wm_cb low_cb, rb_wm_cb high_cb, void *arg);
+#endif /* __RB_WATERMARK__ */
+
 /****************************************************************************
  * rb_peek()    peek
  * @r:          ring buffer 数据结构
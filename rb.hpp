@@ -0,0 +1,130 @@
+/****************************************************************************
+ * @file rb.hpp
+ * @brief Ringbuffer (C++ compile-time specialized wrapper)
+ * @version 0.1
+ ****************************************************************************/
+
+#ifndef __INCLUDE_RINGBUFFER_HPP__
+#define __INCLUDE_RINGBUFFER_HPP__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+ /****************************************************************************
+ 说明:
+
+ 1、C版本rb.c中mask/esize为运行期变量，编译器无法常量折叠回绕掩码，
+    小元素的memcpy也无法退化为单条mov。本头文件提供纯header-only的
+    rb_ring<T, N>模板：容量与元素大小均为编译期常量，push/pop
+    trivially-copyable的T时编译为一次掩码寻址存取加一次索引递增
+
+ 2、与C版本相同的单生产者+单消费者无锁模型，in/out为原子变量，
+    acquire/release语义，布局按RB_CACHELINE思路分cache line存放
+
+ 3、N为元素个数，必须是2的N次幂；类名不复用C API的ringbuffer
+    tag(同一TU同时包含rb.h与rb.hpp时会冲突)；仅为补充，C API保持不变
+
+ ****************************************************************************/
+
+#ifndef RB_CACHELINE
+#define RB_CACHELINE 64
+#endif // !RB_CACHELINE
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+template <typename T, uint32_t N>
+class rb_ring
+{
+    static_assert(N != 0 && (N & (N - 1)) == 0,
+                  "N must be 2^n, for example, 128, 256, 512, 1024...");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable");
+
+public:
+    rb_ring() : in_(0), out_(0) {}
+
+    static constexpr uint32_t size() { return N; }
+    static constexpr uint32_t esize() { return sizeof(T); }
+
+    /* 存入一个元素, 队列满返回false */
+    bool push(const T &val)
+    {
+        uint32_t in = in_.load(std::memory_order_relaxed);
+
+        if (in - out_.load(std::memory_order_acquire) >= N)
+            return false;
+
+        data_[in & mask_] = val;
+        in_.store(in + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* 读出一个元素, 队列空返回false */
+    bool pop(T &val)
+    {
+        uint32_t out = out_.load(std::memory_order_relaxed);
+
+        if (in_.load(std::memory_order_acquire) == out)
+            return false;
+
+        val = data_[out & mask_];
+        out_.store(out + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* 批量存入, 返回实际存入的元素个数 */
+    uint32_t in(const T *buf, uint32_t n_elems)
+    {
+        uint32_t in = in_.load(std::memory_order_relaxed);
+        uint32_t left = N - (in - out_.load(std::memory_order_acquire));
+        uint32_t n = n_elems < left ? n_elems : left;
+        uint32_t l = n < (N - (in & mask_)) ? n : (N - (in & mask_));
+
+        memcpy(&data_[in & mask_], buf, l * sizeof(T));
+        memcpy(&data_[0], buf + l, (n - l) * sizeof(T));
+
+        in_.store(in + n, std::memory_order_release);
+        return n;
+    }
+
+    /* 批量读出, 返回实际读出的元素个数 */
+    uint32_t out(T *buf, uint32_t n_elems)
+    {
+        uint32_t out = out_.load(std::memory_order_relaxed);
+        uint32_t avail = in_.load(std::memory_order_acquire) - out;
+        uint32_t n = n_elems < avail ? n_elems : avail;
+        uint32_t l = n < (N - (out & mask_)) ? n : (N - (out & mask_));
+
+        memcpy(buf, &data_[out & mask_], l * sizeof(T));
+        memcpy(buf + l, &data_[0], (n - l) * sizeof(T));
+
+        out_.store(out + n, std::memory_order_release);
+        return n;
+    }
+
+    uint32_t avail() const
+    {
+        return (in_.load(std::memory_order_acquire) -
+                out_.load(std::memory_order_acquire));
+    }
+
+    uint32_t unused() const { return (N - avail()); }
+    bool is_empty() const { return (avail() == 0); }
+    bool is_full() const { return (avail() >= N); }
+
+private:
+    static constexpr uint32_t mask_ = N - 1;
+
+    alignas(RB_CACHELINE) std::atomic<uint32_t> in_;
+    alignas(RB_CACHELINE) std::atomic<uint32_t> out_;
+    alignas(RB_CACHELINE) T data_[N];
+};
+
+#endif /* __INCLUDE_RINGBUFFER_HPP__ */
@@ -0,0 +1,153 @@
+/****************************************************************************
+ * @file rb_async.hpp
+ * @brief Ringbuffer (C++20 coroutine adapter)
+ * @version 0.1
+ ****************************************************************************/
+
+#ifndef __INCLUDE_RINGBUFFER_ASYNC_HPP__
+#define __INCLUDE_RINGBUFFER_ASYNC_HPP__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include "rb.hpp"
+#include <atomic>
+#include <coroutine>
+
+ /****************************************************************************
+ 说明:
+
+ 1、在rb.hpp的rb_ring<T, N>之上提供协程适配：co_await async_in(v)
+    在队列满时挂起生产者协程, co_await async_out()在队列空时挂起
+    消费者协程, 由对端的下一次成功存取就地resume, 不引入线程/锁/
+    事件循环依赖
+
+ 2、单生产者+单消费者模型：至多一个挂起的生产者协程与一个挂起的
+    消费者协程, 等待句柄各占一个原子槽位(wait_in/wait_out语义与
+    rb.c的futex等待计数对应)。挂起采用"先登记句柄, 再复查条件"
+    的顺序, 与对端"先存取, 再摘取句柄"配对, 保证不丢唤醒
+
+ 3、resume在对端存取调用者的上下文中就地执行, 被唤醒协程的后续
+    代码不得长时间阻塞该上下文; 仅为补充, C API保持不变
+
+ ****************************************************************************/
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+template <typename T, uint32_t N>
+class ringbuffer_async
+{
+public:
+    ringbuffer_async() = default;
+
+    static constexpr uint32_t size() { return N; }
+
+    uint32_t avail() const { return rb_.avail(); }
+    uint32_t unused() const { return rb_.unused(); }
+    bool is_empty() const { return rb_.is_empty(); }
+    bool is_full() const { return rb_.is_full(); }
+
+    /* 非阻塞路径: 成功时顺带唤醒挂起的对端协程 */
+    bool try_push(const T &val)
+    {
+        if (!rb_.push(val))
+            return false;
+
+        wake(wait_in_);
+        return true;
+    }
+
+    bool try_pop(T &val)
+    {
+        if (!rb_.pop(val))
+            return false;
+
+        wake(wait_out_);
+        return true;
+    }
+
+    /* co_await存入一个元素, 队列满时挂起直到消费者读出 */
+    auto async_in(const T &val)
+    {
+        struct awaiter {
+            ringbuffer_async &q;
+            T val;
+            bool done = false;
+
+            bool await_ready() { return (done = q.try_push(val)); }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                /* 先登记句柄再复查: 复查命中说明消费端在登记前后
+                 * 已让出空间, 摘回句柄就地继续, 否则由对端resume */
+                q.wait_out_.store(h.address(), std::memory_order_release);
+                if (!q.is_full() &&
+                    q.wait_out_.exchange(nullptr,
+                                         std::memory_order_acq_rel) != nullptr)
+                    return false;
+                return true;
+            }
+
+            void await_resume()
+            {
+                /* 被唤醒即有空间(单生产者), 兜底自旋防御性重试 */
+                if (!done)
+                    while (!q.try_push(val))
+                        ;
+            }
+        };
+
+        return awaiter{*this, val};
+    }
+
+    /* co_await读出一个元素, 队列空时挂起直到生产者写入 */
+    auto async_out()
+    {
+        struct awaiter {
+            ringbuffer_async &q;
+            T val{};
+            bool got = false;
+
+            bool await_ready() { return (got = q.try_pop(val)); }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                q.wait_in_.store(h.address(), std::memory_order_release);
+                if (!q.is_empty() &&
+                    q.wait_in_.exchange(nullptr,
+                                        std::memory_order_acq_rel) != nullptr)
+                    return false;
+                return true;
+            }
+
+            T await_resume()
+            {
+                if (!got)
+                    while (!q.try_pop(val))
+                        ;
+                return val;
+            }
+        };
+
+        return awaiter{*this};
+    }
+
+private:
+    static void wake(std::atomic<void *> &slot)
+    {
+        void *p = slot.exchange(nullptr, std::memory_order_acq_rel);
+
+        if (p != nullptr)
+            std::coroutine_handle<>::from_address(p).resume();
+    }
+
+    rb_ring<T, N> rb_;
+    /* 等待"空->不空"的消费者协程句柄 */
+    std::atomic<void *> wait_in_{nullptr};
+    /* 等待"满->不满"的生产者协程句柄 */
+    std::atomic<void *> wait_out_{nullptr};
+};
+
+#endif /* __INCLUDE_RINGBUFFER_ASYNC_HPP__ */
@@ -0,0 +1,208 @@
+/****************************************************************************
+ * @file rb_mpmc.c
+ * @brief Ringbuffer (multi-producer/multi-consumer)
+ * @version 0.1
+ ****************************************************************************/
+
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include "rb_mpmc.h"
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#ifdef __DYNAMIC_MALLOC__
+#include <stdlib.h>
+#endif // __DYNAMIC_MALLOC__
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+#define min(a, b) ((a) < (b)? (a): (b))
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef __DYNAMIC_MALLOC__
+static inline uint32_t roundup_pow_of_two(uint32_t len)
+{
+    int i, mask;
+
+    if ((len & (len - 1)) == 0)
+        return len;
+
+    for (i = 31; i >= 0; i--) {
+        mask = 1 << i;
+        if ((len & mask) == mask)
+            break;
+    }
+
+    return (mask << 1);
+}
+#endif // __DYNAMIC_MALLOC__
+
+/* 认领并拷入一个元素, 成功返回1, 队列满返回0
+ * 槽位序号语义(Vyukov bounded queue):
+ *   seq == pos          槽位空闲, 可被生产者认领
+ *   seq == pos + 1      槽位已填充, 可被消费者认领
+ * 生产者CAS认领in后填数据, 再以release发布seq = pos + 1,
+ * 消费者取走后发布seq = pos + size, 供下一圈生产者使用 */
+static int rb_mpmc_put_one(struct ringbuffer_mpmc *r, const uint8_t *buf)
+{
+    uint32_t pos, seq;
+    int32_t dif;
+    _Atomic uint32_t *slot;
+
+    pos = atomic_load_explicit(&r->in, memory_order_relaxed);
+    for (;;) {
+        slot = &r->seq[pos & r->mask];
+        seq = atomic_load_explicit(slot, memory_order_acquire);
+        dif = (int32_t)(seq - pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->in, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+            /* CAS失败时pos已更新为最新值, 重试 */
+        } else if (dif < 0) {
+            /* 上一圈数据还未被取走, 队列满 */
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&r->in, memory_order_relaxed);
+        }
+    }
+
+    memcpy(r->data + (pos & r->mask) * r->esize, buf, r->esize);
+    atomic_store_explicit(slot, pos + 1, memory_order_release);
+    return 1;
+}
+
+/* 认领并拷出一个元素, 成功返回1, 队列空返回0 */
+static int rb_mpmc_get_one(struct ringbuffer_mpmc *r, uint8_t *buf)
+{
+    uint32_t pos, seq;
+    int32_t dif;
+    _Atomic uint32_t *slot;
+
+    pos = atomic_load_explicit(&r->out, memory_order_relaxed);
+    for (;;) {
+        slot = &r->seq[pos & r->mask];
+        seq = atomic_load_explicit(slot, memory_order_acquire);
+        dif = (int32_t)(seq - (pos + 1));
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->out, &pos, pos + 1,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            /* 该槽位还未被生产者发布, 队列空 */
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&r->out, memory_order_relaxed);
+        }
+    }
+
+    memcpy(buf, r->data + (pos & r->mask) * r->esize, r->esize);
+    atomic_store_explicit(slot, pos + r->size, memory_order_release);
+    return 1;
+}
+
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int rb_mpmc_init(struct ringbuffer_mpmc *r, uint32_t len, uint32_t esize)
+{
+    uint32_t i;
+
+    if (r == NULL || len == 0 || esize == 0)
+        return -1;
+
+    r->esize = esize;
+    atomic_init(&r->in, 0);
+    atomic_init(&r->out, 0);
+
+#ifdef __DYNAMIC_MALLOC__
+    r->size = roundup_pow_of_two(len);
+    r->data = (uint8_t *)malloc(r->size * esize);
+    if (r->data == NULL)
+        return -1;
+    r->seq = (_Atomic uint32_t *)malloc(r->size * sizeof(uint32_t));
+    if (r->seq == NULL) {
+        free(r->data);
+        r->data = NULL;
+        return -1;
+    }
+#else // !__DYNAMIC_MALLOC__
+    r->size = RB_BUF_LEN / esize;
+    // r->size must be 2^n, for example, 128, 256, 512, 1024...
+    if ((r->size & (r->size - 1)) != 0)
+        return -1;
+#endif // !__DYNAMIC_MALLOC__
+
+    r->mask = r->size - 1;
+
+    /* 第一圈: 每个槽位序号等于自身下标, 表示空闲 */
+    for (i = 0; i < r->size; i++)
+        atomic_init(&r->seq[i], i);
+
+    return 0;
+}
+
+void rb_mpmc_deinit(struct ringbuffer_mpmc *r)
+{
+    if (r == NULL)
+        return;
+
+    atomic_store_explicit(&r->in, 0, memory_order_release);
+    atomic_store_explicit(&r->out, 0, memory_order_release);
+#ifdef __DYNAMIC_MALLOC__
+    if (r->data != NULL)
+        free(r->data);
+    r->data = NULL;
+    if (r->seq != NULL)
+        free((void *)r->seq);
+    r->seq = NULL;
+#endif // __DYNAMIC_MALLOC__
+}
+
+uint32_t rb_mpmc_in(struct ringbuffer_mpmc *r, const uint8_t *buf,
+                    uint32_t len)
+{
+    uint32_t n = len / r->esize;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        if (!rb_mpmc_put_one(r, buf + i * r->esize))
+            break;
+    }
+
+    return (i * r->esize);
+}
+
+uint32_t rb_mpmc_out(struct ringbuffer_mpmc *r, void *buf, uint32_t len)
+{
+    uint32_t n = len / r->esize;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        if (!rb_mpmc_get_one(r, (uint8_t *)buf + i * r->esize))
+            break;
+    }
+
+    return (i * r->esize);
+}
+
+uint32_t rb_mpmc_avail(struct ringbuffer_mpmc *r)
+{
+    uint32_t in = atomic_load_explicit(&r->in, memory_order_acquire);
+    uint32_t out = atomic_load_explicit(&r->out, memory_order_acquire);
+
+    return ((in - out) * r->esize);
+}
+
+uint32_t rb_mpmc_unused(struct ringbuffer_mpmc *r)
+{
+    return (r->size * r->esize - rb_mpmc_avail(r));
+}
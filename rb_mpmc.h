@@ -0,0 +1,124 @@
+/****************************************************************************
+ * @file rb_mpmc.h
+ * @brief Ringbuffer (multi-producer/multi-consumer)
+ * @version 0.1
+ ****************************************************************************/
+
+#ifndef __INCLUDE_RINGBUFFER_MPMC_H__
+#define __INCLUDE_RINGBUFFER_MPMC_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include <stdint.h>
+#ifndef __cplusplus
+#include <stdatomic.h>
+#endif
+#include "rb.h"
+
+ /****************************************************************************
+ 说明:
+
+ 1、rb.h中的环形队列仅支持单一生产者+单一消费者无锁使用，本文件提供
+    多生产者+多消费者(MPMC)变体，内部为每个槽位维护一个序号(sequence)，
+    生产者/消费者通过CAS认领in/out，无需外部加锁
+
+ 2、MPMC队列以元素为单位收发，每次只认领/发布完整元素，因此len入参需为
+    esize的整数倍，实际传输长度向下取整到整数个元素
+
+ 3、队列长度(元素个数)必须是2的N次幂，计算方式与rb_init()一致：
+    动态内存时为元素个数向上取2的N次幂，静态分配时为RB_BUF_LEN / esize
+
+ 4、接口形态与rb_in()/rb_out()保持一致，便于按队列切换缓冲区类型而
+    无需改写调用方
+
+ ****************************************************************************/
+
+/****************************************************************************
+ * Public Type Declarations
+ ****************************************************************************/
+
+/* MPMC需要per-slot序号数组，无法对调用方完全隐藏布局，
+   结构体成员仅供内部使用，调用方只负责分配 */
+#ifdef __cplusplus
+/* C++侧无_Atomic关键字，仅暴露不透明类型，分配需在C侧完成 */
+struct ringbuffer_mpmc;
+#else // !__cplusplus
+struct ringbuffer_mpmc {
+    _Alignas(RB_CACHELINE > 0 ? RB_CACHELINE : 4) _Atomic uint32_t in;
+    _Alignas(RB_CACHELINE > 0 ? RB_CACHELINE : 4) _Atomic uint32_t out;
+    _Alignas(RB_CACHELINE > 0 ? RB_CACHELINE : 4) uint32_t mask;
+    uint32_t size;      /* 元素个数, 2^N */
+    uint32_t esize;
+#ifdef __DYNAMIC_MALLOC__
+    _Atomic uint32_t *seq;
+    uint8_t  *data;
+#else // !__DYNAMIC_MALLOC__
+    /* 静态分配按esize=1的最坏情况预留序号数组 */
+    _Atomic uint32_t seq[RB_BUF_LEN];
+    uint8_t  data[RB_BUF_LEN];
+#endif // !__DYNAMIC_MALLOC__
+};
+#endif // !__cplusplus
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * rb_mpmc_init()   初始化MPMC ring buffer
+ * @r:              ring buffer 数据结构，为静态变量地址或堆指针
+ * @len:            使能动态内存策略时，为元素个数，
+ *                  否则忽略，元素个数 = RB_BUF_LEN / esize
+ * @esize:          需存储的单个元素的长度
+ *
+ * 返回值：         0 初始化完成
+ *                  -1 初始化失败
+ ****************************************************************************/
+int rb_mpmc_init(struct ringbuffer_mpmc *r, uint32_t len, uint32_t esize);
+
+/****************************************************************************
+ * rb_mpmc_deinit() 去初始化，如使能动态内存，则释放内部buffer
+ ****************************************************************************/
+void rb_mpmc_deinit(struct ringbuffer_mpmc *r);
+
+/****************************************************************************
+ * rb_mpmc_in()     将数据存入循环队列，可多线程并发调用
+ * @r:              ring buffer 数据结构
+ * @buf:            待存储数据
+ * @len:            待存储数据长度，需为esize的整数倍
+ *
+ * 返回值：         实际存入的数据长度(整数个元素)
+ ****************************************************************************/
+uint32_t rb_mpmc_in(struct ringbuffer_mpmc *r, const uint8_t *buf,
+                    uint32_t len);
+
+/****************************************************************************
+ * rb_mpmc_out()    从循环队列中读取数据，可多线程并发调用
+ * @r:              ring buffer 数据结构
+ * @buf:            读取数据存储buffer
+ * @len:            需要读取的数据长度，需为esize的整数倍
+ *
+ * 返回值：         实际读取到的数据长度(整数个元素)
+ ****************************************************************************/
+uint32_t rb_mpmc_out(struct ringbuffer_mpmc *r, void *buf, uint32_t len);
+
+/****************************************************************************
+ * rb_mpmc_avail()  当前队列中可用数据长度(字节)，并发下为瞬时近似值
+ ****************************************************************************/
+uint32_t rb_mpmc_avail(struct ringbuffer_mpmc *r);
+
+/****************************************************************************
+ * rb_mpmc_unused() 当前队列中剩余空间(字节)，并发下为瞬时近似值
+ ****************************************************************************/
+uint32_t rb_mpmc_unused(struct ringbuffer_mpmc *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_RINGBUFFER_MPMC_H__ */
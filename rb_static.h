@@ -0,0 +1,163 @@
+/****************************************************************************
+ * @file rb_static.h
+ * @brief Ringbuffer (embedded static instance, header-only)
+ * @version 0.1
+ ****************************************************************************/
+
+#ifndef __INCLUDE_RINGBUFFER_STATIC_H__
+#define __INCLUDE_RINGBUFFER_STATIC_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/****************************************************************************
+ 说明:
+
+ 1、rb.c面向带堆或统一RB_BUF_LEN的场景, 每次存取为一次函数调用,
+    mask/esize为运行期变量。嵌入式ISR与主循环间的单字节队列(串口
+    收发等)希望容量按实例定制、put/get路径完全内联：本头文件提供
+    RB_DEFINE(name, len)宏定义静态实例, 容量由sizeof在编译期折叠,
+    RB_PUT单字节路径编译为一次掩码寻址存储加一次索引递增
+
+ 2、与rb.c相同的单生产者+单消费者无锁模型：一侧在ISR中, 另一侧在
+    线程/主循环中, 无需关中断; in/out为free-running原子索引,
+    acquire/release语义, 弱内存序CPU上同样成立
+
+ 3、len必须是2的N次幂; 仅为补充, 不依赖rb.h/rb.c
+
+ ****************************************************************************/
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/****************************************************************************
+ * RB_DEFINE()  定义一个容量为len字节的静态ring buffer实例
+ * @name:       实例名
+ * @len:        容量(字节), 必须是2的N次幂
+ ****************************************************************************/
+#define RB_DEFINE(name, len)                                        \
+    _Static_assert(((len) != 0) && (((len) & ((len) - 1)) == 0),    \
+                   #name ": len must be 2^n");                      \
+    static struct {                                                 \
+        _Atomic uint32_t    in;                                     \
+        _Atomic uint32_t    out;                                    \
+        uint8_t data[len];                                          \
+    } name = { 0, 0, { 0 } }
+
+/* 容量与掩码由sizeof得到, 对RB_DEFINE的实例为编译期常量 */
+#define RB_SIZE(name)       ((uint32_t)sizeof((name).data))
+#define RB_MASK(name)       (RB_SIZE(name) - 1)
+
+#define RB_AVAIL(name)                                              \
+    (atomic_load_explicit(&(name).in, memory_order_acquire) -      \
+     atomic_load_explicit(&(name).out, memory_order_acquire))
+#define RB_UNUSED(name)     (RB_SIZE(name) - RB_AVAIL(name))
+#define RB_IS_EMPTY(name)   (RB_AVAIL(name) == 0)
+#define RB_IS_FULL(name)    (RB_AVAIL(name) >= RB_SIZE(name))
+
+/* 仅在两侧均静默时调用 */
+#define RB_RESET(name)                                              \
+    do {                                                            \
+        atomic_store_explicit(&(name).out, 0,                       \
+                              memory_order_relaxed);                \
+        atomic_store_explicit(&(name).in, 0,                        \
+                              memory_order_relaxed);                \
+    } while (0)
+
+/****************************************************************************
+ * RB_PUT()     存入一个字节, 队列满返回0, 成功返回1
+ * RB_GET()     读出一个字节到*pc, 队列空返回0, 成功返回1
+ * RB_WRITE()   批量存入, 返回实际存入字节数
+ * RB_READ()    批量读出, 返回实际读出字节数
+ ****************************************************************************/
+#define RB_PUT(name, c)                                             \
+    __rb_s_put(&(name).in, &(name).out, (name).data,                \
+               RB_MASK(name), (c))
+#define RB_GET(name, pc)                                            \
+    __rb_s_get(&(name).in, &(name).out, (name).data,                \
+               RB_MASK(name), (pc))
+#define RB_WRITE(name, buf, len)                                    \
+    __rb_s_write(&(name).in, &(name).out, (name).data,              \
+                 RB_MASK(name), (buf), (len))
+#define RB_READ(name, buf, len)                                     \
+    __rb_s_read(&(name).in, &(name).out, (name).data,               \
+                RB_MASK(name), (buf), (len))
+
+/****************************************************************************
+ * Inline Functions
+ ****************************************************************************/
+
+/* mask经宏展开后为编译期常量, 内联后无任何运行期除法/取模 */
+static inline int __rb_s_put(_Atomic uint32_t *inp, _Atomic uint32_t *outp,
+                             uint8_t *data, uint32_t mask, uint8_t c)
+{
+    uint32_t in = atomic_load_explicit(inp, memory_order_relaxed);
+
+    if (in - atomic_load_explicit(outp, memory_order_acquire) > mask)
+        return 0;
+
+    data[in & mask] = c;
+    atomic_store_explicit(inp, in + 1, memory_order_release);
+    return 1;
+}
+
+static inline int __rb_s_get(_Atomic uint32_t *inp, _Atomic uint32_t *outp,
+                             uint8_t *data, uint32_t mask, uint8_t *pc)
+{
+    uint32_t out = atomic_load_explicit(outp, memory_order_relaxed);
+
+    if (atomic_load_explicit(inp, memory_order_acquire) == out)
+        return 0;
+
+    *pc = data[out & mask];
+    atomic_store_explicit(outp, out + 1, memory_order_release);
+    return 1;
+}
+
+static inline uint32_t __rb_s_write(_Atomic uint32_t *inp,
+                                    _Atomic uint32_t *outp, uint8_t *data,
+                                    uint32_t mask, const uint8_t *buf,
+                                    uint32_t len)
+{
+    uint32_t in = atomic_load_explicit(inp, memory_order_relaxed);
+    uint32_t left = mask + 1 -
+                    (in - atomic_load_explicit(outp, memory_order_acquire));
+    uint32_t l;
+
+    len = len < left ? len : left;
+    l = mask + 1 - (in & mask);
+    l = len < l ? len : l;
+
+    memcpy(&data[in & mask], buf, l);
+    memcpy(&data[0], buf + l, len - l);
+
+    atomic_store_explicit(inp, in + len, memory_order_release);
+    return len;
+}
+
+static inline uint32_t __rb_s_read(_Atomic uint32_t *inp,
+                                   _Atomic uint32_t *outp, uint8_t *data,
+                                   uint32_t mask, uint8_t *buf,
+                                   uint32_t len)
+{
+    uint32_t out = atomic_load_explicit(outp, memory_order_relaxed);
+    uint32_t avail = atomic_load_explicit(inp, memory_order_acquire) - out;
+    uint32_t l;
+
+    len = len < avail ? len : avail;
+    l = mask + 1 - (out & mask);
+    l = len < l ? len : l;
+
+    memcpy(buf, &data[out & mask], l);
+    memcpy(buf + l, &data[0], len - l);
+
+    atomic_store_explicit(outp, out + len, memory_order_release);
+    return len;
+}
+
+#endif /* __INCLUDE_RINGBUFFER_STATIC_H__ */